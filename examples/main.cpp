@@ -1,6 +1,7 @@
 #include "fmu/api.hpp"
 
 #include <cstdio>
+#include <ctime>
 #include <string>
 #include <vector>
 
@@ -13,7 +14,7 @@ int main() {
 	printf("1. Creating sample data...\n");
 	std::vector<fmu::CompositeData> records;
 	fmu::CompositeData r{};
-	r.location.timestampMs = 1730000000000LL;  // 2024-10-28
+	r.location.timestampMs = static_cast<int64_t>(std::time(nullptr)) * 1000;  // Now (kept by DeleteOldData)
 	r.location.latitude = 10.762622;           // Ho Chi Minh City
 	r.location.longitude = 106.660172;
 	r.location.accurate = 5.0;
@@ -52,8 +53,21 @@ int main() {
 	printf("   ✓ DRIVER_VIOLATION_BEHAVIOR written to file\n");
 	printf("\n");
 
+	// Test API 1b: RestoreDataBatch - One vehicle event, all 3 data types in one commit
+	printf("3. Writing one vehicle event atomically (RestoreDataBatch)...\n");
+	std::vector<fmu::DataBatchEntry> batch = {
+		{fmu::DataType::GPS_DATA, records},
+		{fmu::DataType::DRIVER_INFORMATION, records},
+		{fmu::DataType::DRIVER_VIOLATION_BEHAVIOR, records}
+	};
+	if (!fmu::RestoreDataBatch(batch, &err)) {
+		printf("   ❌ Batch Error: %s\n", err.c_str());
+		return 1;
+	}
+	printf("   ✓ All 3 data types committed together\n\n");
+
 	// Test API 2: DeleteOldData (delete files older than X days)
-	printf("3. Deleting old files (DeleteOldData)...\n");
+	printf("4. Deleting old files (DeleteOldData)...\n");
 	if (!fmu::DeleteOldData(fmu::DataType::GPS_DATA, 30, &err)) {
 		printf("   ❌ Error: %s\n", err.c_str());
 		return 1;
@@ -61,7 +75,7 @@ int main() {
 	printf("   ✓ Successfully deleted old files (older than 30 days)\n\n");
 
 	// Test API 3: RetrieveData - Read from all 3 data types
-	printf("4. Reading data from different data types (RetrieveData)...\n");
+	printf("5. Reading data from different data types (RetrieveData)...\n");
 	
 	// GPS Data
 	auto gpsOut = fmu::RetrieveData(fmu::DataType::GPS_DATA, 0, 0, &err);
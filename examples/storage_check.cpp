@@ -0,0 +1,179 @@
+#include "fmu/api.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Storage check across process restarts. test_linux.sh runs the phases in order,
+// each as a separate process on an empty FMU_STORAGE_DIR:
+//   write      - out-of-order records inside the reorder window, clean exit
+//   write-late - records older than the partition tail, then exit without shutdown (power loss)
+//   batch      - damaged and torn commits left in the journal, then a GPS + driver batch on top of them
+//   crash-apply- journal and partition file as left by a crash in the middle of an apply
+//   recover    - restart: recover the journal, clean exit (drains windows to files)
+//   verify     - check partition files, late file and RetrieveData
+
+static const int64_t kBaseTs = 1730000000000LL;  // 2024-10-27
+static const int kRecordCount = 200;             // kBaseTs + 0..199 s
+static const int kLateCount = 10;                // kBaseTs + 50.5..59.5 s
+static const int64_t kBatchTs = kBaseTs + 300000;   // Batch record (GPS + driver information)
+static const int64_t kApplyTs = kBaseTs + 400000;   // Record of the interrupted apply
+
+static fmu::CompositeData makeRecord(int64_t tsMs) {
+	fmu::CompositeData r{};
+	r.location.timestampMs = tsMs;
+	r.location.latitude = 10.762622;
+	r.location.longitude = 106.660172;
+	r.location.valid = true;
+	r.location.fixType = 3;
+	return r;
+}
+
+static std::string storageDir() {
+	const char* env = ::getenv("FMU_STORAGE_DIR");
+	return (env && *env) ? env : "./data";
+}
+
+// Partition file path for kBaseTs, same naming as the library
+static std::string partitionPath(const char* suffix, const char* type = "GPS_data") {
+	std::time_t t = static_cast<std::time_t>(kBaseTs / 1000);
+	char date[16];
+	std::strftime(date, sizeof(date), "%Y_%m_%d", std::localtime(&t));
+	return storageDir() + "/" + type + "_" + date + suffix;
+}
+
+static void appendText(const std::string& path, const std::string& text) {
+	std::ofstream out(path, std::ios::app | std::ios::binary);
+	out << text;
+}
+
+// CRC-32 (IEEE 802.3), same as the journal commit marker
+static uint32_t crc32(const std::string& data) {
+	uint32_t crc = 0xFFFFFFFFu;
+	for (unsigned char c : data) {
+		crc ^= c;
+		for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+	}
+	return ~crc;
+}
+
+// Journal commit: the given lines followed by their "#commit,{lines},{crc32}" marker
+static std::string journalCommit(const std::string& lines) {
+	size_t count = 0;
+	for (char c : lines) count += (c == '\n');
+	return lines + "#commit," + std::to_string(count) + "," + std::to_string(crc32(lines)) + "\n";
+}
+
+// Timestamps (first CSV field) of all lines in a file
+static std::vector<int64_t> readTimestamps(const std::string& path) {
+	std::vector<int64_t> ts;
+	std::ifstream in(path);
+	std::string line;
+	while (std::getline(in, line)) {
+		if (!line.empty()) ts.push_back(std::strtoll(line.c_str(), nullptr, 10));
+	}
+	return ts;
+}
+
+static bool check(bool ok, const char* what) {
+	printf("   %s %s\n", ok ? "✓" : "❌", what);
+	return ok;
+}
+
+int main(int argc, char** argv) {
+	std::string phase = argc > 1 ? argv[1] : "";
+	std::string err;
+
+	if (phase == "write") {
+		// Second half first, then first half: all within the 60 s reorder window of each other
+		std::vector<fmu::CompositeData> second, first;
+		for (int i = 0; i < kRecordCount; ++i) {
+			(i < kRecordCount / 2 ? first : second).push_back(makeRecord(kBaseTs + i * 1000LL));
+		}
+		if (!fmu::RestoreData(fmu::DataType::GPS_DATA, second, &err) ||
+			!fmu::RestoreData(fmu::DataType::GPS_DATA, first, &err)) {
+			printf("   ❌ RestoreData: %s\n", err.c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	if (phase == "write-late") {
+		std::vector<fmu::CompositeData> late;
+		for (int i = 0; i < kLateCount; ++i) late.push_back(makeRecord(kBaseTs + 50500 + i * 1000LL));
+		if (!fmu::RestoreData(fmu::DataType::GPS_DATA, late, &err)) {
+			printf("   ❌ RestoreData: %s\n", err.c_str());
+			return 1;
+		}
+		std::_Exit(0); // No shutdown drain: records must be recovered from the journal
+	}
+
+	if (phase == "batch") {
+		// A commit whose record does not match its marker (damaged after the write),
+		// then a commit torn by power loss: no trailing newline, no commit marker
+		std::string damaged = journalCommit("Driver_information," + std::to_string(kBatchTs - 1000) + ",0,0,0,1,3,0,0,0,0,0\n");
+		damaged[damaged.find(',', damaged.find(',') + 1) - 1] ^= 1;  // Last digit of the timestamp
+		appendText(storageDir() + "/journal.txt", damaged + "Driver_information,17400");
+		std::vector<fmu::DataBatchEntry> batch = {
+			{fmu::DataType::GPS_DATA, {makeRecord(kBatchTs)}},
+			{fmu::DataType::DRIVER_INFORMATION, {makeRecord(kBatchTs)}}
+		};
+		if (!fmu::RestoreDataBatch(batch, &err)) {
+			printf("   ❌ RestoreDataBatch: %s\n", err.c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	if (phase == "crash-apply") {
+		// Record committed, apply intent committed, partition appended, journal not yet rewritten
+		std::string mainPath = partitionPath(".txt");
+		std::ifstream in(mainPath, std::ios::binary | std::ios::ate);
+		long long size = static_cast<long long>(in.tellg());
+		std::string line = std::to_string(kApplyTs) + ",0,0,0,1,3,0,0,0,0,0\n";
+		appendText(storageDir() + "/journal.txt", journalCommit("GPS_data," + line)
+			+ journalCommit("#apply," + std::to_string(size) + "," + mainPath + "\n"));
+		appendText(mainPath, line);
+		return 0;
+	}
+
+	if (phase == "recover") {
+		auto out = fmu::RetrieveData(fmu::DataType::GPS_DATA, 0, 0, &err);
+		return check(out.size() == 1 && err.empty(), "journal recovered after restart") ? 0 : 1;
+	}
+
+	if (phase == "verify") {
+		bool ok = true;
+
+		// Partition file: every record once, in timestamp order (then the batch and apply records)
+		std::vector<int64_t> expected;
+		for (int i = 0; i < kRecordCount; ++i) expected.push_back(kBaseTs + i * 1000LL);
+		expected.push_back(kBatchTs);
+		expected.push_back(kApplyTs);
+		ok &= check(readTimestamps(partitionPath(".txt")) == expected,
+			"partition file holds every record once, in timestamp order");
+
+		// Batch: driver information committed together with GPS, torn commit dropped
+		ok &= check(readTimestamps(partitionPath(".txt", "Driver_information")) == std::vector<int64_t>{kBatchTs},
+			"batch record of the second data type kept, damaged and torn commits dropped");
+
+		// Late file: the records that arrived after the partition moved on, as one sorted run
+		std::vector<int64_t> lateTs = readTimestamps(partitionPath(".late.txt"));
+		bool lateOk = lateTs.size() == static_cast<size_t>(kLateCount);
+		for (size_t i = 0; lateOk && i < lateTs.size(); ++i) lateOk = lateTs[i] == kBaseTs + 50500 + static_cast<int64_t>(i) * 1000;
+		ok &= check(lateOk, "late file holds the late records as one sorted run");
+
+		// Read: newest record across the partition, its late file and the window
+		auto out = fmu::RetrieveData(fmu::DataType::GPS_DATA, 0, 0, &err);
+		ok &= check(err.empty() && out.size() == 1 && out[0].location.timestampMs == kApplyTs,
+			"RetrieveData returns the newest record");
+		return ok ? 0 : 1;
+	}
+
+	printf("usage: %s write|write-late|batch|crash-apply|recover|verify\n", argv[0]);
+	return 2;
+}
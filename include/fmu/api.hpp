@@ -18,35 +18,61 @@ enum class DataType {
 	DRIVER_VIOLATION_BEHAVIOR    // Driver violation behavior
 };
 
+// Records of one data type inside a batch write (see RestoreDataBatch)
+struct DataBatchEntry {
+	DataType dataType;                    // Type of data to save
+	std::vector<CompositeData> records;   // Records to write for this type
+};
+
 // ============================================================================
 // 3 MAIN APIs FOR USERS
 // ============================================================================
 
 // API 1: WRITE NEW DATA (append data to date-based file)
 // - dataType: type of data to save (GPS_DATA, DRIVER_INFORMATION, DRIVER_VIOLATION_BEHAVIOR)
-// - records: list of data to write (will be appended to file for current date)
+// - records: list of data to write (each record goes to the file for the date of its own timestamp)
 // - errorMessage: error message (can be nullptr)
-// - Returns: true on success, false on error
-// - Note: Creates a new file each day with format: {data_type}_YYYY_MM_DD.txt
+// - Returns: true once records are durable in the journal, false on error
+// - Note: One file per date with format: {data_type}_YYYY_MM_DD.txt, kept in timestamp order
+//         Records are committed to the shared journal (journal.txt) and held in a small reorder
+//         window so that slightly late records are written in order; a background worker then
+//         moves them to the date files. Records later than the window go to
+//         {data_type}_YYYY_MM_DD.late.txt as sorted runs, which reads check as well.
+//         If a background apply has failed since the last call, errorMessage is set but true is
+//         returned (records stay in the journal and are retried).
+//         Returns false if the backlog of unapplied records for a data type is full: more than
+//         16384 records already waiting, or more than 4096 while background applies are failing.
+//         The size of the new batch itself is not limited.
 //         Always appends new data, never deletes existing data in file
 bool RestoreData(DataType dataType, const std::vector<CompositeData>& records, std::string* errorMessage = nullptr);
 
+// API 1b: WRITE SEVERAL DATA TYPES ATOMICALLY (e.g. all records produced by one vehicle event)
+// - batch: records for one or more data types
+// - errorMessage: error message (can be nullptr)
+// - Returns: true once the whole batch is durable in the journal, false on error
+// - Note: The batch is written to the shared journal with one fsync, so either all data types
+//         in the batch survive a crash or none do. Files and errors are handled as for RestoreData.
+bool RestoreDataBatch(const std::vector<DataBatchEntry>& batch, std::string* errorMessage = nullptr);
+
 // API 2: DELETE OLD FILES (delete files older than specified days)
 // - dataType: type of data to delete files for
 // - daysOlder: delete files older than this many days from current time
 // - errorMessage: error message (can be nullptr)
 // - Returns: true on success, false on error
-// - Note: Deletes entire files, not data within files. Used when storage is full.
+// - Note: Deletes entire files (including late side files), not data within files. Used when storage is full.
 bool DeleteOldData(DataType dataType, int daysOlder, std::string* errorMessage = nullptr);
 
-// API 3: READ DATA (get last data from newest file, like top function)
+// API 3: READ DATA (get newest record by timestamp, like top function)
 // - dataType: type of data to retrieve (same as RestoreData parameter)
 // - fromTsMs: start timestamp (milliseconds) - kept for compatibility but not used
 // - toTsMs: end timestamp (milliseconds) - kept for compatibility but not used
 // - errorMessage: error message (can be nullptr)
-// - Returns: list containing the last data block from the newest file for the data type
-// - Note: Retrieves the last data block (most recent record) from the newest file (file with latest date)
-//         Similar to a "top" function in arrays, returns the last data entry from the newest file
+// - Returns: list containing the newest record for the data type
+// - Note: Retrieves the record with the latest timestamp from the newest file (file with latest date),
+//         its late side file and the records still in the reorder window
+//         Only the tail of the newest file is read, outside the storage lock
+//         errorMessage also reports a background apply failure since the last call
+//         Similar to a "top" function in arrays, returns the last data entry in timestamp order
 std::vector<CompositeData> RetrieveData(DataType dataType, int64_t fromTsMs, int64_t toTsMs, std::string* errorMessage = nullptr);
 
 } // namespace fmu
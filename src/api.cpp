@@ -23,7 +23,13 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
 #include <iomanip>
+#include <map>
+#include <mutex>
+#include <thread>
 
 // ============================================================================
 // UTILITY FUNCTIONS - FOR FILE OPERATIONS
@@ -50,17 +56,35 @@ std::string dataTypeToString(fmu::DataType dataType) {
 	}
 }
 
-// Get current date string in format YYYY_MM_DD
-std::string getCurrentDateString() {
-	std::time_t now = std::time(nullptr);
+// All data types (for code that iterates over every type)
+const fmu::DataType kAllDataTypes[] = {
+	fmu::DataType::GPS_DATA,
+	fmu::DataType::DRIVER_INFORMATION,
+	fmu::DataType::DRIVER_VIOLATION_BEHAVIOR
+};
+
+// Convert string from dataTypeToString back to DataType
+// Returns false if the string is not a known data type
+bool stringToDataType(const std::string& str, fmu::DataType& out) {
+	for (fmu::DataType dataType : kAllDataTypes) {
+		if (dataTypeToString(dataType) == str) {
+			out = dataType;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Format a time_t as local date string YYYY_MM_DD
+std::string formatDateString(std::time_t t) {
 	struct tm* timeinfo;
 #ifdef _WIN32
 	// Use thread-safe localtime on Windows (localtime_s is MSVC-specific)
-	timeinfo = std::localtime(&now);
+	timeinfo = std::localtime(&t);
 	if (!timeinfo) return "1970_01_01"; // Fallback
 #else
 	struct tm timeinfoBuf;
-	timeinfo = localtime_r(&now, &timeinfoBuf);
+	timeinfo = localtime_r(&t, &timeinfoBuf);
 	if (!timeinfo) return "1970_01_01"; // Fallback
 #endif
 	std::ostringstream oss;
@@ -71,6 +95,18 @@ std::string getCurrentDateString() {
 	return oss.str();
 }
 
+// Get current date string in format YYYY_MM_DD
+std::string getCurrentDateString() {
+	return formatDateString(std::time(nullptr));
+}
+
+// Get partition date string (YYYY_MM_DD) for a record timestamp
+// Records without a usable timestamp fall back to the current date
+std::string timestampToDateString(int64_t tsMs) {
+	if (tsMs <= 0) return getCurrentDateString();
+	return formatDateString(static_cast<std::time_t>(tsMs / 1000));
+}
+
 // Get file path separator
 std::string getPathSeparator() {
 #ifdef _WIN32
@@ -80,26 +116,30 @@ std::string getPathSeparator() {
 #endif
 }
 
+// Suffix of main partition files and of their late side files
+const char* const kPartitionSuffix = ".txt";
+const char* const kLateSuffix = ".late.txt";
+
 // Get file path for a data type and date
-std::string getFilePathForDate(fmu::DataType dataType, const std::string& dateStr) {
+std::string getFilePathForDate(fmu::DataType dataType, const std::string& dateStr, const std::string& suffix = kPartitionSuffix) {
 	std::string typeStr = dataTypeToString(dataType);
-	return getStorageDir() + getPathSeparator() + typeStr + "_" + dateStr + ".txt";
+	return getStorageDir() + getPathSeparator() + typeStr + "_" + dateStr + suffix;
 }
 
-// Get file path for current date
-std::string getCurrentFilePath(fmu::DataType dataType) {
-	return getFilePathForDate(dataType, getCurrentDateString());
+// Get file path of the shared write-ahead journal (staging for all data types)
+std::string getJournalFilePath() {
+	return getStorageDir() + getPathSeparator() + "journal.txt";
 }
 
-// Parse date from filename (format: {type}_YYYY_MM_DD.txt)
+// Parse date from filename (format: {type}_YYYY_MM_DD{suffix})
 // Returns empty string if parsing fails
-std::string parseDateFromFilename(const std::string& filename, const std::string& expectedPrefix) {
-	// Expected format: {prefix}_YYYY_MM_DD.txt
+std::string parseDateFromFilename(const std::string& filename, const std::string& expectedPrefix, const std::string& suffix = kPartitionSuffix) {
+	// Expected format: {prefix}_YYYY_MM_DD{suffix}
 	std::string prefix = expectedPrefix + "_";
-	if (filename.size() < prefix.size() + 11) return ""; // YYYY_MM_DD.txt = 11 chars
+	if (filename.size() != prefix.size() + 10 + suffix.size()) return ""; // YYYY_MM_DD = 10 chars
 	
 	if (filename.substr(0, prefix.size()) != prefix) return "";
-	if (filename.substr(filename.size() - 4) != ".txt") return "";
+	if (filename.substr(filename.size() - suffix.size()) != suffix) return "";
 	
 	std::string datePart = filename.substr(prefix.size(), 10); // YYYY_MM_DD = 10 chars
 	// Basic validation: check format YYYY_MM_DD
@@ -135,7 +175,7 @@ int64_t dateStringToTimestamp(const std::string& dateStr) {
 }
 
 // Get list of files for a data type, sorted by date (newest first)
-std::vector<std::string> getFilesForDataType(fmu::DataType dataType) {
+std::vector<std::string> getFilesForDataType(fmu::DataType dataType, const std::string& suffix = kPartitionSuffix) {
 	std::vector<std::string> files;
 	std::string prefix = dataTypeToString(dataType);
 	std::string dir = getStorageDir();
@@ -143,13 +183,13 @@ std::vector<std::string> getFilesForDataType(fmu::DataType dataType) {
 #ifdef _WIN32
 	WIN32_FIND_DATAA findData;
 	std::string sep = getPathSeparator();
-	std::string pattern = dir + sep + prefix + "_*.txt";
+	std::string pattern = dir + sep + prefix + "_*" + suffix;
 	HANDLE hFind = FindFirstFileA(pattern.c_str(), &findData);
 	if (hFind != INVALID_HANDLE_VALUE) {
 		do {
 			if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
 				std::string filename(findData.cFileName);
-				std::string dateStr = parseDateFromFilename(filename, prefix);
+				std::string dateStr = parseDateFromFilename(filename, prefix, suffix);
 				if (!dateStr.empty()) {
 					files.push_back(dir + sep + filename);
 				}
@@ -163,7 +203,7 @@ std::vector<std::string> getFilesForDataType(fmu::DataType dataType) {
 		struct dirent* entry;
 		while ((entry = readdir(dp)) != nullptr) {
 			std::string filename = entry->d_name;
-			std::string dateStr = parseDateFromFilename(filename, prefix);
+			std::string dateStr = parseDateFromFilename(filename, prefix, suffix);
 			if (!dateStr.empty()) {
 				std::string sep = getPathSeparator();
 				files.push_back(dir + sep + filename);
@@ -174,9 +214,9 @@ std::vector<std::string> getFilesForDataType(fmu::DataType dataType) {
 #endif
 	
 	// Sort files by date (newest first)
-	std::sort(files.begin(), files.end(), [&prefix](const std::string& a, const std::string& b) {
-		std::string dateA = parseDateFromFilename(a.substr(a.find_last_of("/\\") + 1), prefix);
-		std::string dateB = parseDateFromFilename(b.substr(b.find_last_of("/\\") + 1), prefix);
+	std::sort(files.begin(), files.end(), [&prefix, &suffix](const std::string& a, const std::string& b) {
+		std::string dateA = parseDateFromFilename(a.substr(a.find_last_of("/\\") + 1), prefix, suffix);
+		std::string dateB = parseDateFromFilename(b.substr(b.find_last_of("/\\") + 1), prefix, suffix);
 		return dateA > dateB; // Newest first
 	});
 	
@@ -300,14 +340,653 @@ bool csvToRecord(const std::string& line, fmu::CompositeData& out) {
 	}
 }
 
+// Parse all CSV lines in a buffer, skipping lines that fail to parse
+void parseRecords(const std::string& content, std::vector<fmu::CompositeData>& out) {
+	fmu::CompositeData rec{};
+	size_t start = 0;
+	for (size_t i = 0; i <= content.size(); ++i) {
+		if (i == content.size() || content[i] == '\n') {
+			std::string line(content.data() + start, i - start);
+			start = i + 1;
+			if (line.empty()) continue;
+			
+			// Convert CSV line to record
+			if (csvToRecord(line, rec)) {
+				out.push_back(rec);
+			}
+		}
+	}
+}
+
+// ============================================================================
+// RECORD FILE OPERATIONS
+// ============================================================================
+
+// Flush file data to disk
+bool syncFile(int fd) {
+#ifdef _WIN32
+	return ::_commit(fd) == 0;
+#else
+	return ::fsync(fd) == 0;
+#endif
+}
+
+// Flush the directory containing a file, so a created or renamed entry survives power loss
+bool syncParentDir(const std::string& filePath, std::string* err) {
+#ifdef _WIN32
+	(void)filePath;
+	(void)err;
+	return true; // Directory entries cannot be flushed separately on Windows
+#else
+	size_t lastSep = filePath.find_last_of('/');
+	std::string dir = (lastSep == std::string::npos) ? std::string(".") : filePath.substr(0, lastSep);
+	int fd = ::open(dir.c_str(), O_RDONLY);
+	if (fd < 0) {
+		if (err) *err = std::string("Cannot open directory: ") + std::strerror(errno);
+		return false;
+	}
+	bool ok = syncFile(fd);
+	int savedErrno = errno;
+	::close(fd);
+	if (!ok) {
+		if (err) *err = std::string("Directory sync failed: ") + std::strerror(savedErrno);
+		return false;
+	}
+	return true;
+#endif
+}
+
+// Append a buffer to a file in a single write and flush to disk (creates the file if needed)
+// On failure the file is truncated back to its previous size, so no partial line is left behind
+// A newly created file is made durable in its directory unless syncNewEntry is false
+bool appendToFile(const std::string& filePath, const std::string& buf, std::string* err, bool syncNewEntry = true) {
+	bool created = ::access(filePath.c_str(), F_OK) != 0;
+	int fd = ::open(filePath.c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644);
+	if (fd < 0) {
+		if (err) *err = std::string("Cannot open file for appending: ") + std::strerror(errno);
+		return false;
+	}
+	
+	off_t startSize = ::lseek(fd, 0, SEEK_END);
+	bool ok = startSize >= 0 && writeAll(fd, buf.data(), buf.size()) && syncFile(fd);
+	int savedErrno = errno;
+	if (!ok && startSize >= 0 && ::ftruncate(fd, startSize) == 0) {
+		syncFile(fd);
+	}
+	::close(fd);
+	if (!ok) {
+		if (err) *err = std::string("Write failed: ") + std::strerror(savedErrno);
+		return false;
+	}
+	if (created && syncNewEntry) return syncParentDir(filePath, err);
+	return true;
+}
+
+// Append records to a file and flush to disk (creates the file if needed)
+bool appendRecordsToFile(const std::string& filePath, const std::vector<fmu::CompositeData>& records, std::string* err) {
+	// Build all lines first so the batch goes out in a single write
+	std::string buf;
+	for (const auto& r : records) buf += recordToCSV(r);
+	return appendToFile(filePath, buf, err);
+}
+
+// Replace a file with the given content (write temp file, flush, rename, flush directory)
+bool replaceFile(const std::string& filePath, const std::string& buf, std::string* err) {
+	std::string tmpPath = filePath + ".tmp";
+	::unlink(tmpPath.c_str());
+	if (!appendToFile(tmpPath, buf, err, false)) return false;
+#ifdef _WIN32
+	::remove(filePath.c_str()); // rename does not overwrite on Windows
+#endif
+	if (::rename(tmpPath.c_str(), filePath.c_str()) != 0) {
+		if (err) *err = std::string("Rename failed: ") + std::strerror(errno);
+		return false;
+	}
+	
+	// Without this the old file can come back after power loss
+	return syncParentDir(filePath, err);
+}
+
+// Read all records from a file (a missing file yields no records)
+bool readRecordsFromFile(const std::string& filePath, std::vector<fmu::CompositeData>& out, std::string* err) {
+	int fd = ::open(filePath.c_str(), O_RDONLY);
+	if (fd < 0) {
+		if (errno == ENOENT) return true;
+		if (err) *err = std::string("Cannot open file: ") + std::strerror(errno);
+		return false;
+	}
+	
+	std::string content;
+	bool ok = readAll(fd, content);
+	int savedErrno = errno;
+	::close(fd);
+	if (!ok) {
+		if (err) *err = std::string("Read failed: ") + std::strerror(savedErrno);
+		return false;
+	}
+	
+	parseRecords(content, out);
+	return true;
+}
+
+// Read the last complete record in a file
+// Only the file tail is read, and a line still being appended is ignored
+bool readLastRecord(const std::string& filePath, fmu::CompositeData& out) {
+	int fd = ::open(filePath.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	
+	bool found = false;
+	struct stat st{};
+	if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+		const off_t tailSize = 4096;
+		off_t offset = st.st_size > tailSize ? st.st_size - tailSize : 0;
+		std::string tail;
+		if (::lseek(fd, offset, SEEK_SET) == offset && readAll(fd, tail)) {
+			// Keep complete lines only: drop the first (possibly partial) line unless
+			// we read from the start, and anything after the last newline
+			size_t end = tail.rfind('\n');
+			if (end != std::string::npos) {
+				size_t begin = (offset > 0) ? tail.find('\n') + 1 : 0;
+				std::vector<fmu::CompositeData> records;
+				if (begin <= end) parseRecords(tail.substr(begin, end + 1 - begin), records);
+				if (!records.empty()) {
+					out = records.back();
+					found = true;
+				}
+			}
+		}
+	}
+	::close(fd);
+	return found;
+}
+
+// Read timestamp of the last complete record in a file
+// Returns INT64_MIN if the file has no records.
+int64_t readLastTimestamp(const std::string& filePath) {
+	fmu::CompositeData last{};
+	return readLastRecord(filePath, last) ? last.location.timestampMs : INT64_MIN;
+}
+
+// ============================================================================
+// WRITE-AHEAD JOURNAL - SHARED STAGING FOR ALL DATA TYPES
+// ============================================================================
+//
+// Every commit appends its records to journal.txt with a single write and
+// fsync. Each line is "{type},{csv record}" and a commit ends with a marker
+// line "#commit,{lines},{crc32}" giving the number of lines in the commit and
+// the CRC-32 of their bytes, so records of all types in one commit become
+// durable together. On recovery, lines after the last marker belong to a torn
+// commit, and a commit whose line count or CRC does not match its marker was
+// not fully written (or was damaged); both are dropped as a whole. Records are applied to the per-type files in the background and
+// the journal is then rewritten to hold only records not yet applied.
+//
+// Before an apply touches any file it commits "#apply,{size},{path}" lines
+// giving each file's size before the append. If the process dies before the
+// journal is rewritten, recovery truncates those files back to that size and
+// the records are applied again from the journal, so nothing is duplicated.
+
+const char* const kJournalCommitMarker = "#commit";
+const char* const kJournalApplyPrefix = "#apply,";
+
+// Records of one commit grouped by data type
+typedef std::map<fmu::DataType, std::vector<fmu::CompositeData>> JournalBatch;
+
+// Append one record of a data type as a journal line
+void appendJournalLine(std::string& buf, fmu::DataType dataType, const fmu::CompositeData& r) {
+	buf += dataTypeToString(dataType);
+	buf += ',';
+	buf += recordToCSV(r);
+}
+
+// CRC-32 (IEEE 802.3) of a byte range
+uint32_t crc32(const char* data, size_t len) {
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < len; ++i) {
+		crc ^= static_cast<unsigned char>(data[i]);
+		for (int bit = 0; bit < 8; ++bit) {
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+		}
+	}
+	return ~crc;
+}
+
+// Append the commit marker that closes a journal commit
+// buf must hold exactly the lines of this commit
+void appendJournalCommit(std::string& buf) {
+	size_t lineCount = static_cast<size_t>(std::count(buf.begin(), buf.end(), '\n'));
+	uint32_t crc = crc32(buf.data(), buf.size());
+	buf += kJournalCommitMarker;
+	buf += ',';
+	buf += std::to_string(lineCount);
+	buf += ',';
+	buf += std::to_string(crc);
+	buf += '\n';
+}
+
+// Parse a commit marker line: #commit,{lines},{crc32}
+bool parseJournalCommitMarker(const std::string& line, size_t& lineCount, uint32_t& crc) {
+	size_t markerLen = std::strlen(kJournalCommitMarker);
+	if (line.compare(0, markerLen, kJournalCommitMarker) != 0 || line.size() <= markerLen || line[markerLen] != ',') return false;
+	const char* p = line.c_str() + markerLen + 1;
+	char* end = nullptr;
+	errno = 0;
+	unsigned long long n = std::strtoull(p, &end, 10);
+	if (end == p || *end != ',' || errno != 0) return false;
+	p = end + 1;
+	unsigned long long c = std::strtoull(p, &end, 10);
+	if (end == p || *end != '\0' || errno != 0 || c > 0xFFFFFFFFull) return false;
+	lineCount = static_cast<size_t>(n);
+	crc = static_cast<uint32_t>(c);
+	return true;
+}
+
+// Append apply intent: size of a file before the apply appends to it
+void appendJournalApplyIntent(std::string& buf, const std::string& filePath, off_t startSize) {
+	buf += kJournalApplyPrefix;
+	buf += std::to_string(static_cast<long long>(startSize));
+	buf += ',';
+	buf += filePath;
+	buf += '\n';
+}
+
+// Parse journal content, keeping only records and apply intents of complete commits
+// applyIntents receives the smallest recorded start size per file
+// Returns the length of the committed prefix (bytes up to and including the last marker)
+size_t parseJournal(const std::string& content, JournalBatch& out, std::map<std::string, off_t>& applyIntents) {
+	JournalBatch commit;
+	std::map<std::string, off_t> commitIntents;
+	size_t commitStart = 0;
+	size_t commitLines = 0;
+	size_t committedSize = 0;
+	fmu::CompositeData rec{};
+	fmu::DataType dataType;
+	size_t start = 0;
+	for (size_t i = 0; i <= content.size(); ++i) {
+		if (i == content.size() || content[i] == '\n') {
+			size_t lineStart = start;
+			std::string line(content.data() + start, i - start);
+			start = i + 1;
+			if (line.empty()) continue;
+			
+			// Commit marker: everything since the previous marker is durable,
+			// if the line count and CRC match what was written
+			if (line.compare(0, std::strlen(kJournalCommitMarker), kJournalCommitMarker) == 0) {
+				size_t markerLines = 0;
+				uint32_t markerCrc = 0;
+				if (parseJournalCommitMarker(line, markerLines, markerCrc) && markerLines == commitLines
+					&& markerCrc == crc32(content.data() + commitStart, lineStart - commitStart)) {
+					for (auto& entry : commit) {
+						auto& dst = out[entry.first];
+						dst.insert(dst.end(), entry.second.begin(), entry.second.end());
+					}
+					for (const auto& intent : commitIntents) {
+						auto it = applyIntents.find(intent.first);
+						if (it == applyIntents.end() || intent.second < it->second) applyIntents[intent.first] = intent.second;
+					}
+				}
+				commit.clear();
+				commitIntents.clear();
+				commitStart = start;
+				commitLines = 0;
+				committedSize = start;
+				continue;
+			}
+			++commitLines;
+			
+			// Apply intent line: #apply,{size},{path}
+			if (line.compare(0, std::strlen(kJournalApplyPrefix), kJournalApplyPrefix) == 0) {
+				std::string rest = line.substr(std::strlen(kJournalApplyPrefix));
+				size_t sep = rest.find(',');
+				if (sep == std::string::npos) continue;
+				try {
+					commitIntents[rest.substr(sep + 1)] = static_cast<off_t>(std::stoll(rest.substr(0, sep)));
+				} catch (...) {
+				}
+				continue;
+			}
+			
+			// Record line: {type},{csv record}
+			size_t comma = line.find(',');
+			if (comma == std::string::npos) continue;
+			if (!stringToDataType(line.substr(0, comma), dataType)) continue;
+			if (csvToRecord(line.substr(comma + 1), rec)) {
+				commit[dataType].push_back(rec);
+			}
+		}
+	}
+	return std::min(committedSize, content.size());
+}
+
+// ============================================================================
+// REORDER WINDOW - ROUTES RECORDS TO THE PARTITION OF THEIR OWN TIMESTAMP
+// ============================================================================
+//
+// Records committed to the journal are held in a small per-type reorder
+// window in memory. Once a record is more than kReorderWindowMs behind the
+// newest timestamp seen, it is drained in timestamp order to
+// {type}_YYYY_MM_DD.txt for its own date. A record that arrives too late for
+// the window (older than the last record already in its partition) goes to
+// {type}_YYYY_MM_DD.late.txt instead; every drain appends one sorted run
+// there, and reads check those runs as well. Sparse streams are not held
+// back indefinitely (see kReorderMaxHoldMs).
+
+// Records closer than this to the newest timestamp stay in the window
+const int64_t kReorderWindowMs = 60 * 1000;
+// Upper bound on records held in the window (oldest are drained beyond this)
+const size_t kReorderMaxRecords = 4096;
+// Minimum number of drainable records before partition files are written
+const size_t kReorderDrainBatch = 64;
+// Drainable records held in the window this long are written whatever their count,
+// and a window with no new records for this long is drained completely (sparse streams)
+const int64_t kReorderMaxHoldMs = 5 * 60 * 1000;
+// Interval at which the background worker re-checks windows without new commits
+const int64_t kApplyIntervalMs = 30 * 1000;
+// Commits are rejected once a window already holds this many records (applies cannot keep up),
+// or more than kReorderMaxRecords while applies are failing
+const size_t kReorderBacklogLimit = 4 * kReorderMaxRecords;
+
+struct ReorderState {
+	int64_t maxSeenTs = INT64_MIN;
+	int64_t lastInsertMs = 0;                // Monotonic time of the last insert
+	std::vector<fmu::CompositeData> pending; // Sorted by timestamp (stable)
+	std::vector<int64_t> heldSinceMs;        // Monotonic insert time of each pending record
+};
+
+std::mutex g_storageMutex;                              // Guards all state below
+bool g_journalLoaded = false;                           // Reorder windows recovered from the journal
+std::map<fmu::DataType, ReorderState> g_reorderStates;  // Reorder window per data type
+std::map<std::string, int64_t> g_partitionLastTs;       // Partition file path -> last timestamp written
+std::string g_lastApplyError;                           // Last background apply error, not yet reported
+bool g_applyFailing = false;                            // Last background apply failed
+
+// Monotonic clock in milliseconds (for window hold and idle time)
+int64_t monotonicNowMs() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Insert records into the window, keeping it sorted by timestamp
+void insertIntoReorderWindow(ReorderState& state, const std::vector<fmu::CompositeData>& records) {
+	if (!records.empty()) state.lastInsertMs = monotonicNowMs();
+	for (const auto& r : records) {
+		auto pos = std::upper_bound(state.pending.begin(), state.pending.end(), r,
+			[](const fmu::CompositeData& a, const fmu::CompositeData& b) {
+				return a.location.timestampMs < b.location.timestampMs;
+			});
+		state.heldSinceMs.insert(state.heldSinceMs.begin() + (pos - state.pending.begin()), state.lastInsertMs);
+		state.pending.insert(pos, r);
+		state.maxSeenTs = std::max(state.maxSeenTs, r.location.timestampMs);
+	}
+}
+
+// Rewrite the journal with the records still held in the reorder windows (as one commit)
+// Caller must hold g_storageMutex
+bool rewriteJournal(std::string* err) {
+	std::string buf;
+	for (const auto& entry : g_reorderStates) {
+		for (const auto& r : entry.second.pending) appendJournalLine(buf, entry.first, r);
+	}
+	if (!buf.empty()) appendJournalCommit(buf);
+	return replaceFile(getJournalFilePath(), buf, err);
+}
+
+// Recover reorder windows of all data types from the journal on first use
+// Caller must hold g_storageMutex
+bool ensureJournalLoaded(std::string* err) {
+	if (g_journalLoaded) return true;
+	
+	int fd = ::open(getJournalFilePath().c_str(), O_RDONLY);
+	if (fd < 0) {
+		if (errno != ENOENT) {
+			if (err) *err = std::string("Cannot open journal: ") + std::strerror(errno);
+			return false;
+		}
+	} else {
+		std::string content;
+		bool ok = readAll(fd, content);
+		int savedErrno = errno;
+		::close(fd);
+		if (!ok) {
+			if (err) *err = std::string("Read failed: ") + std::strerror(savedErrno);
+			return false;
+		}
+		
+		JournalBatch staged;
+		std::map<std::string, off_t> applyIntents;
+		size_t committedSize = parseJournal(content, staged, applyIntents);
+		
+		// Drop a torn commit at the tail so the next commit is not appended onto it
+		if (committedSize < content.size() && ::truncate(getJournalFilePath().c_str(), static_cast<off_t>(committedSize)) != 0) {
+			if (err) *err = std::string("Cannot truncate journal: ") + std::strerror(errno);
+			return false;
+		}
+		for (const auto& entry : staged) {
+			insertIntoReorderWindow(g_reorderStates[entry.first], entry.second);
+		}
+		
+		// Undo appends of an interrupted apply; its records are still in the journal
+		if (!applyIntents.empty()) {
+			for (const auto& intent : applyIntents) {
+				struct stat st{};
+				if (::stat(intent.first.c_str(), &st) == 0 && st.st_size > intent.second
+					&& ::truncate(intent.first.c_str(), intent.second) != 0) {
+					if (err) *err = std::string("Cannot undo interrupted apply: ") + std::strerror(errno);
+					return false;
+				}
+			}
+			if (!rewriteJournal(err)) return false;
+		}
+	}
+	
+	g_journalLoaded = true;
+	return true;
+}
+
+// Get last timestamp written to a partition file (cached after first lookup)
+// Caller must hold g_storageMutex
+int64_t getPartitionLastTimestamp(const std::string& filePath) {
+	auto it = g_partitionLastTs.find(filePath);
+	if (it != g_partitionLastTs.end()) return it->second;
+	int64_t lastTs = readLastTimestamp(filePath);
+	g_partitionLastTs[filePath] = lastTs;
+	return lastTs;
+}
+
+// One append to a partition file or late side file during a journal apply
+struct ApplyWrite {
+	fmu::DataType dataType;
+	std::string filePath;
+	bool isPartition;                          // Main partition file (tail timestamp is cached)
+	std::vector<fmu::CompositeData> records;
+	off_t startSize;                           // File size before the append
+};
+
+// Writes of the apply in progress; their records are out of the windows but may
+// not be in the files yet. Only the applying thread modifies it.
+std::vector<ApplyWrite> g_applyPlan;
+// Set while the apply writes files without the lock; g_applyWriteDone is notified when it ends
+bool g_applyWriting = false;
+std::condition_variable g_applyWriteDone;
+
+// Move records that left the reorder window into apply writes
+// drainAll moves every record (used on shutdown)
+// Caller must hold g_storageMutex
+void planReorderDrain(fmu::DataType dataType, ReorderState& state, bool drainAll, std::vector<ApplyWrite>& plan) {
+	if (state.pending.empty()) return;
+	
+	// Step 1: Count records older than the window (plus overflow beyond the cap)
+	// A window without new records for kReorderMaxHoldMs is drained completely
+	size_t eligible = 0;
+	int64_t cutoffTs = state.maxSeenTs - kReorderWindowMs;
+	while (eligible < state.pending.size() && state.pending[eligible].location.timestampMs <= cutoffTs) {
+		++eligible;
+	}
+	if (state.pending.size() > kReorderMaxRecords) {
+		eligible = std::max(eligible, state.pending.size() - kReorderMaxRecords);
+	}
+	bool idle = monotonicNowMs() - state.lastInsertMs >= kReorderMaxHoldMs;
+	if (drainAll || idle) eligible = state.pending.size();
+	
+	// Step 2: Batch small drains to keep the number of fsyncs low,
+	// unless an eligible record has been held in the window too long
+	if (eligible == 0) return;
+	int64_t oldestHeldMs = *std::min_element(state.heldSinceMs.begin(), state.heldSinceMs.begin() + eligible);
+	bool overdue = monotonicNowMs() - oldestHeldMs >= kReorderMaxHoldMs;
+	if (eligible < kReorderDrainBatch && state.pending.size() <= kReorderMaxRecords && !overdue && !drainAll && !idle) return;
+	
+	// Step 3: Split by date partition (records of one date are contiguous)
+	size_t begin = 0;
+	while (begin < eligible) {
+		std::string dateStr = timestampToDateString(state.pending[begin].location.timestampMs);
+		size_t end = begin + 1;
+		while (end < eligible && timestampToDateString(state.pending[end].location.timestampMs) == dateStr) ++end;
+		
+		// Records older than the partition tail go to the late side file as one sorted run
+		std::string mainPath = getFilePathForDate(dataType, dateStr);
+		int64_t lastTs = getPartitionLastTimestamp(mainPath);
+		size_t split = begin;
+		while (split < end && state.pending[split].location.timestampMs < lastTs) ++split;
+		
+		if (split > begin) {
+			plan.push_back(ApplyWrite{dataType, getFilePathForDate(dataType, dateStr, kLateSuffix), false,
+				std::vector<fmu::CompositeData>(state.pending.begin() + begin, state.pending.begin() + split), 0});
+		}
+		if (end > split) {
+			plan.push_back(ApplyWrite{dataType, mainPath, true,
+				std::vector<fmu::CompositeData>(state.pending.begin() + split, state.pending.begin() + end), 0});
+		}
+		begin = end;
+	}
+	
+	// Step 4: Records now belong to the plan
+	state.pending.erase(state.pending.begin(), state.pending.begin() + eligible);
+	state.heldSinceMs.erase(state.heldSinceMs.begin(), state.heldSinceMs.begin() + eligible);
+}
+
+// Apply the journal: drain all reorder windows to their files, then rewrite
+// the journal without the applied records
+// drainAll empties the reorder windows completely (used on shutdown)
+// Caller must hold g_storageMutex through lock; it is released while files are written
+bool applyJournal(std::unique_lock<std::mutex>& lock, bool drainAll, std::string* err) {
+	// Step 1: Collect records that left their reorder window
+	std::vector<ApplyWrite>& plan = g_applyPlan;
+	plan.clear();
+	for (auto& entry : g_reorderStates) {
+		planReorderDrain(entry.first, entry.second, drainAll, plan);
+	}
+	if (plan.empty()) return true;
+	
+	// Step 2: Commit apply intent (file sizes before the appends) to the journal
+	std::string intent;
+	for (auto& w : plan) {
+		struct stat st{};
+		w.startSize = (::stat(w.filePath.c_str(), &st) == 0) ? st.st_size : 0;
+		appendJournalApplyIntent(intent, w.filePath, w.startSize);
+	}
+	appendJournalCommit(intent);
+	size_t written = 0;
+	bool ok = appendToFile(getJournalFilePath(), intent, err);
+	
+	// Step 3: Append records to partition and late files without holding the lock,
+	// so commits and reads are not blocked behind these fsyncs
+	if (ok) {
+		std::string writeErr;
+		g_applyWriting = true;
+		lock.unlock();
+		while (written < plan.size() && appendRecordsToFile(plan[written].filePath, plan[written].records, &writeErr)) {
+			++written;
+		}
+		lock.lock();
+		g_applyWriting = false;
+		g_applyWriteDone.notify_all();
+		if (written < plan.size()) {
+			if (err) *err = writeErr;
+			ok = false;
+		}
+	}
+	
+	// Step 4: Cache new partition tails; records not written go back to their reorder windows
+	for (size_t i = 0; i < plan.size(); ++i) {
+		if (i < written) {
+			if (plan[i].isPartition) g_partitionLastTs[plan[i].filePath] = plan[i].records.back().location.timestampMs;
+		} else {
+			insertIntoReorderWindow(g_reorderStates[plan[i].dataType], plan[i].records);
+		}
+	}
+	plan.clear();
+	if (written == 0) return ok;
+	
+	// Step 5: Drop applied records (and the apply intent) from the journal
+	if (!rewriteJournal(err)) return false;
+	return ok;
+}
+
+// Background worker that applies the journal after each commit and every kApplyIntervalMs
+// A failed apply leaves records in the journal; they are retried on the next round
+// On shutdown the reorder windows are drained completely so date files are up to date
+struct JournalApplier {
+	std::thread worker;
+	std::condition_variable wake;
+	bool requested = false;
+	bool stopping = false;
+	
+	~JournalApplier() {
+		{
+			std::lock_guard<std::mutex> lock(g_storageMutex);
+			stopping = true;
+		}
+		wake.notify_one();
+		if (worker.joinable()) worker.join();
+		
+		std::unique_lock<std::mutex> lock(g_storageMutex);
+		if (g_journalLoaded) {
+			std::string err;
+			applyJournal(lock, true, &err);
+		}
+	}
+};
+
+JournalApplier g_journalApplier;
+
+void journalApplierLoop() {
+	std::unique_lock<std::mutex> lock(g_storageMutex);
+	for (;;) {
+		bool woken = g_journalApplier.wake.wait_for(lock, std::chrono::milliseconds(kApplyIntervalMs),
+			[] { return g_journalApplier.requested || g_journalApplier.stopping; });
+		if (g_journalApplier.requested || !woken) {
+			g_journalApplier.requested = false;
+			std::string err;
+			g_applyFailing = !applyJournal(lock, false, &err);
+			if (g_applyFailing) g_lastApplyError = err;
+		}
+		if (g_journalApplier.stopping) return;
+	}
+}
+
+// Wake the background worker (started on first use)
+// Caller must hold g_storageMutex
+void requestJournalApply() {
+	if (!g_journalApplier.worker.joinable()) {
+		g_journalApplier.worker = std::thread(journalApplierLoop);
+	}
+	g_journalApplier.requested = true;
+	g_journalApplier.wake.notify_one();
+}
+
 // ============================================================================
 // 3 MAIN APIs FOR USERS
 // ============================================================================
 
 namespace fmu {
 
-// API 1: WRITE NEW DATA (append data to date-based file)
+// API 1: WRITE NEW DATA (append data to the partition of each record's timestamp)
 bool RestoreData(DataType dataType, const std::vector<CompositeData>& records, std::string* errorMessage) {
+	// Single data type is a batch with one entry
+	return RestoreDataBatch({DataBatchEntry{dataType, records}}, errorMessage);
+}
+
+// API 1b: WRITE SEVERAL DATA TYPES ATOMICALLY (one journal commit)
+bool RestoreDataBatch(const std::vector<DataBatchEntry>& batch, std::string* errorMessage) {
 	// Step 1: Create storage directory if it doesn't exist
 	std::string err;
 	if (!ensureDirExists(&err)) {
@@ -315,43 +994,54 @@ bool RestoreData(DataType dataType, const std::vector<CompositeData>& records, s
 		return false;
 	}
 	
-	// Step 2: Get file path for current date
-	const std::string filePath = getCurrentFilePath(dataType);
+	// Step 2: Build journal commit for all data types (records + commit marker)
+	std::string buf;
+	for (const auto& entry : batch) {
+		for (const auto& r : entry.records) appendJournalLine(buf, entry.dataType, r);
+	}
+	if (buf.empty()) return true;
+	appendJournalCommit(buf);
 	
-	// Step 3: Open file for appending (O_APPEND) or create if doesn't exist
-	int fd = ::open(filePath.c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644);
-	if (fd < 0) {
-		if (errorMessage) *errorMessage = std::string("Cannot open file for appending: ") + std::strerror(errno);
+	std::lock_guard<std::mutex> lock(g_storageMutex);
+	
+	// Step 3: Recover reorder windows from the journal on first use
+	if (!ensureJournalLoaded(&err)) {
+		if (errorMessage) *errorMessage = err;
 		return false;
 	}
 	
-	// Step 4: Write each record to file (append mode)
-	bool ok = true;
-	for (const auto& r : records) {
-		std::string line = recordToCSV(r);
-		if (!writeAll(fd, line.data(), line.size())) { 
-			ok = false; 
-			break; 
+	// Step 4: Refuse to grow the backlog without bound while applies fail or cannot keep up
+	// Only the existing backlog counts, so a large upload into a healthy store is accepted
+	for (const auto& entry : batch) {
+		size_t backlog = g_reorderStates[entry.dataType].pending.size();
+		if (backlog > kReorderBacklogLimit || (g_applyFailing && backlog > kReorderMaxRecords)) {
+			if (errorMessage) {
+				*errorMessage = "Journal backlog full for " + dataTypeToString(entry.dataType);
+				if (!g_lastApplyError.empty()) *errorMessage += ": " + g_lastApplyError;
+			}
+			return false;
 		}
 	}
 	
-	// Step 5: Ensure data is written to disk
-	if (ok) {
-#ifdef _WIN32
-		if (::_commit(fd) != 0) ok = false;
-#else
-		if (::fsync(fd) != 0) ok = false;
-#endif
+	// Step 5: Append commit to the journal with one write and one fsync
+	// Once this succeeds all records in the batch are durable
+	if (!appendToFile(getJournalFilePath(), buf, &err)) {
+		if (errorMessage) *errorMessage = err;
+		return false;
 	}
 	
-	// Step 6: Close file
-	int savedErrno = errno;
-	::close(fd);
+	// Step 6: Add records to the in-memory reorder windows
+	for (const auto& entry : batch) {
+		insertIntoReorderWindow(g_reorderStates[entry.dataType], entry.records);
+	}
 	
-	// Step 7: Report error if any
-	if (!ok) {
-		if (errorMessage) *errorMessage = std::string("Write failed: ") + std::strerror(savedErrno);
-		return false;
+	// Step 7: Apply to per-type files in the background
+	requestJournalApply();
+	
+	// Step 8: Report a failed background apply as a warning (records stay in the journal)
+	if (!g_lastApplyError.empty()) {
+		if (errorMessage) *errorMessage = "Background apply failed: " + g_lastApplyError;
+		g_lastApplyError.clear();
 	}
 	
 	return true;
@@ -399,32 +1089,61 @@ bool DeleteOldData(DataType dataType, int daysOlder, std::string* errorMessage)
 			<< std::setw(2) << cutoffTime.tm_mday;
 		std::string cutoffDateStr = cutoffOss.str();
 		
-		// Step 3: Get all files for this data type
-		auto files = getFilesForDataType(dataType);
+		// Step 3: Drop records of expired dates that are not applied yet, so a later
+		// apply does not recreate the deleted files (waits for an apply in progress)
+		std::unique_lock<std::mutex> lock(g_storageMutex);
+		g_applyWriteDone.wait(lock, [] { return !g_applyWriting; });
+		std::string err;
+		if (!ensureJournalLoaded(&err)) {
+			if (errorMessage) *errorMessage = err;
+			return false;
+		}
+		ReorderState& state = g_reorderStates[dataType];
+		size_t keptCount = 0;
+		for (size_t i = 0; i < state.pending.size(); ++i) {
+			if (timestampToDateString(state.pending[i].location.timestampMs) >= cutoffDateStr) {
+				state.heldSinceMs[keptCount] = state.heldSinceMs[i];
+				state.pending[keptCount++] = state.pending[i];
+			}
+		}
+		if (keptCount < state.pending.size()) {
+			state.pending.resize(keptCount);
+			state.heldSinceMs.resize(keptCount);
+			if (!rewriteJournal(&err)) {
+				if (errorMessage) *errorMessage = err;
+				return false;
+			}
+		}
 		
-		// Step 4: Delete files older than cutoff date
+		// Step 4: Get all partition files and late side files for this data type
 		std::string prefix = dataTypeToString(dataType);
 		int deletedCount = 0;
 		
-		for (const auto& filePath : files) {
-			// Extract filename from full path
-			size_t lastSep = filePath.find_last_of("/\\");
-			std::string filename = (lastSep == std::string::npos) ? filePath : filePath.substr(lastSep + 1);
+		for (const std::string suffix : {kPartitionSuffix, kLateSuffix}) {
+			auto files = getFilesForDataType(dataType, suffix);
 			
-			// Parse date from filename
-			std::string fileDateStr = parseDateFromFilename(filename, prefix);
-			if (fileDateStr.empty()) continue;
-			
-			// Compare date strings directly (YYYY_MM_DD format sorts lexicographically)
-			// Delete file if file date < cutoff date
-			if (fileDateStr < cutoffDateStr) {
-				if (::unlink(filePath.c_str()) != 0) {
-					// Log error but continue deleting other files
-					if (errorMessage && errorMessage->empty()) {
-						*errorMessage = std::string("Failed to delete some files: ") + std::strerror(errno);
+			// Step 5: Delete files older than cutoff date
+			for (const auto& filePath : files) {
+				// Extract filename from full path
+				size_t lastSep = filePath.find_last_of("/\\");
+				std::string filename = (lastSep == std::string::npos) ? filePath : filePath.substr(lastSep + 1);
+				
+				// Parse date from filename
+				std::string fileDateStr = parseDateFromFilename(filename, prefix, suffix);
+				if (fileDateStr.empty()) continue;
+				
+				// Compare date strings directly (YYYY_MM_DD format sorts lexicographically)
+				// Delete file if file date < cutoff date
+				if (fileDateStr < cutoffDateStr) {
+					if (::unlink(filePath.c_str()) != 0) {
+						// Log error but continue deleting other files
+						if (errorMessage && errorMessage->empty()) {
+							*errorMessage = std::string("Failed to delete some files: ") + std::strerror(errno);
+						}
+					} else {
+						g_partitionLastTs.erase(filePath);
+						deletedCount++;
 					}
-				} else {
-					deletedCount++;
 				}
 			}
 		}
@@ -436,60 +1155,63 @@ bool DeleteOldData(DataType dataType, int daysOlder, std::string* errorMessage)
 	}
 }
 
-// API 3: READ DATA (get last data from newest file, like top function)
+// API 3: READ DATA (get newest record by timestamp, like top function)
 std::vector<CompositeData> RetrieveData(DataType dataType, int64_t fromTsMs, int64_t toTsMs, std::string* errorMessage) {
 	std::vector<CompositeData> result;
+	std::string err;
+	CompositeData newest{};
+	bool found = false;
 	
-	// Step 1: Get newest file path for this data type
-	std::string srcPath = getNewestFilePath(dataType);
-	if (srcPath.empty()) {
-		// No files exist for this data type, return empty list
-		return result;
-	}
-	
-	// Step 2: Open file for reading
-	int inFd = ::open(srcPath.c_str(), O_RDONLY);
-	if (inFd < 0) {
-		if (errno == ENOENT) return result; // File doesn't exist, return empty list
-		if (errorMessage) *errorMessage = std::string("Cannot open file: ") + std::strerror(errno);
-		return result;
-	}
+	// Keep the newest of what has been found so far
+	auto consider = [&](const CompositeData& r) {
+		if (!found || r.location.timestampMs > newest.location.timestampMs) {
+			newest = r;
+			found = true;
+		}
+	};
 	
-	// Step 3: Read entire file content
-	std::string content;
-	bool ok = readAll(inFd, content);
-	int savedErrno = errno;
-	::close(inFd);
-	if (!ok) {
-		if (errorMessage) *errorMessage = std::string("Read failed: ") + std::strerror(savedErrno);
-		return result;
+	{
+		std::lock_guard<std::mutex> lock(g_storageMutex);
+		
+		// Step 1: Newest record still in the reorder window (window is sorted by timestamp)
+		if (!ensureJournalLoaded(&err)) {
+			if (errorMessage) *errorMessage = err;
+		} else if (!g_reorderStates[dataType].pending.empty()) {
+			consider(g_reorderStates[dataType].pending.back());
+		}
+		
+		// Records of an apply in progress may not have reached their files yet
+		for (const auto& w : g_applyPlan) {
+			if (w.dataType == dataType) consider(w.records.back());
+		}
+		
+		// Report a failed background apply as a warning (records stay in the journal)
+		if (!g_lastApplyError.empty()) {
+			if (errorMessage) *errorMessage = "Background apply failed: " + g_lastApplyError;
+			g_lastApplyError.clear();
+		}
 	}
 	
-	// Step 4: Parse all records from file
-	std::vector<CompositeData> allRecords;
-	fmu::CompositeData rec{};
-	size_t start = 0;
-	for (size_t i = 0; i <= content.size(); ++i) {
-		if (i == content.size() || content[i] == '\n') {
-			std::string line(content.data() + start, i - start);
-			start = i + 1;
-			if (line.empty()) continue;
-			
-			// Convert CSV line to record
-			if (csvToRecord(line, rec)) {
-				allRecords.push_back(rec);
-			}
+	// Step 2: Read the newest date partition without holding the lock. Records that
+	// leave the window from here on were already considered in Step 1.
+	// Main file is in timestamp order, so its last complete record is its newest;
+	// the late side file holds sorted runs, so its newest can be anywhere in it.
+	std::string srcPath = getNewestFilePath(dataType);
+	if (!srcPath.empty()) {
+		std::string dateStr = parseDateFromFilename(srcPath.substr(srcPath.find_last_of("/\\") + 1), dataTypeToString(dataType));
+		CompositeData last{};
+		if (readLastRecord(srcPath, last)) consider(last);
+		
+		std::vector<CompositeData> lateRecords;
+		if (!readRecordsFromFile(getFilePathForDate(dataType, dateStr, kLateSuffix), lateRecords, &err)) {
+			if (errorMessage) *errorMessage = err;
 		}
+		for (const auto& r : lateRecords) consider(r);
 	}
 	
-	// Step 5: Return the last data block (like top function)
-	// Get the last block of data from the file
-	// We return the last record(s) from the file (the most recent data)
-	// For now, we return the last record as it represents the most recent data point
-	// If there are multiple records with same timestamp at the end, we could return all of them
-	if (!allRecords.empty()) {
-		// Return the last record (most recent data in file)
-		result.push_back(allRecords.back());
+	// Step 3: Return the newest record overall (like top function)
+	if (found) {
+		result.push_back(newest);
 	}
 	
 	return result;
@@ -68,12 +68,13 @@ else
 fi
 echo
 
-# Test 2: Check file creation
+# Test 2: Check file creation (today's record must survive DeleteOldData in the example)
 echo "Test 2: File creation"
-if [ -f "data/store.ndjson" ]; then
+TODAY=$(date +%Y_%m_%d)
+if [ -f "data/GPS_data_${TODAY}.txt" ]; then
     echo "✅ Data file created successfully"
     echo "File contents:"
-    cat data/store.ndjson
+    cat "data/GPS_data_${TODAY}.txt"
     echo
 else
     echo "❌ Data file not created"
@@ -85,7 +86,7 @@ echo "Test 3: Custom storage directory"
 export FMU_STORAGE_DIR="/tmp/fmu_test"
 mkdir -p /tmp/fmu_test
 ./fmu_example
-if [ -f "/tmp/fmu_test/store.ndjson" ]; then
+if [ -f "/tmp/fmu_test/GPS_data_${TODAY}.txt" ]; then
     echo "✅ Custom storage directory works"
     rm -rf /tmp/fmu_test
 else
@@ -94,4 +95,19 @@ else
 fi
 echo
 
+# Test 4: Reorder window, late runs, torn commits and restart recovery (one process per phase)
+echo "Test 4: Out-of-order records across restarts"
+export FMU_STORAGE_DIR="/tmp/fmu_check"
+rm -rf /tmp/fmu_check
+for phase in write write-late batch crash-apply recover verify; do
+    ./fmu_storage_check $phase
+    if [ $? -ne 0 ]; then
+        echo "❌ Storage check failed in phase: $phase"
+        exit 1
+    fi
+done
+rm -rf /tmp/fmu_check
+echo "✅ Out-of-order records stored in order"
+echo
+
 echo "🎉 All tests passed! Code is ready for Linux deployment."
\ No newline at end of file